@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+#include "animate.hh"
+
+// longest frame side, matching the preview window in main. it also keeps
+// frames of long corridor mazes inside the 65535 pixels MJPG can encode
+#define AN_FRAME_PX 1024
+#define AN_FPS      30
+
+frame_pipeline::frame_pipeline (const std::string &path, int every,
+                                int capacity, int log_level)
+    : path_ (path), every_ (every), capacity_ (std::max (1, capacity)),
+      log_level_ (log_level), scale_ (1), shrink_ (1)
+{
+}
+
+frame_pipeline::~frame_pipeline ()
+{
+    if (encoder_.joinable ()) {
+        {
+            std::lock_guard<std::mutex> lk (mtx_);
+            done_ = true;
+        }
+        cv_.notify_all ();
+        encoder_.join ();
+    }
+}
+
+void
+frame_pipeline::start (const cv::Mat &maze)
+{
+    CV_Assert (maze.depth () == CV_8U && maze.channels () == 1);
+
+    // about 256 frames for the whole generation unless told otherwise
+    if (every_ < 1) {
+        long long cells = (long long)((maze.rows - 1) / 2)
+                          * ((maze.cols - 1) / 2);
+        every_ = (int)std::max (1LL, cells / 256);
+    }
+
+    int side = std::max (maze.rows, maze.cols);
+    cols_    = maze.cols;
+    scale_   = std::max (1, AN_FRAME_PX / side);
+    shrink_  = (side + AN_FRAME_PX - 1) / AN_FRAME_PX;
+    if (shrink_ > 1) {
+        int rows = (maze.rows + shrink_ - 1) / shrink_;
+        int cols = (maze.cols + shrink_ - 1) / shrink_;
+        scaled_  = cv::Mat::zeros (rows, cols, CV_8UC1);
+        full_    = cv::Mat::zeros (maze.rows, maze.cols, CV_8UC1);
+        sums_.assign ((size_t)rows * cols, 0);
+    } else {
+        scaled_ = cv::Mat::zeros (maze.rows * scale_, maze.cols * scale_,
+                                  CV_8UC1);
+    }
+
+    // a `%' pattern is an image sequence, which takes no codec
+    int fourcc = path_.find ('%') != std::string::npos
+                     ? 0
+                     : cv::VideoWriter::fourcc ('M', 'J', 'P', 'G');
+    writer_.open (path_, fourcc, AN_FPS, scaled_.size (), false);
+    if (!writer_.isOpened () && log_level_ > 0) {
+        std::cerr << "[ \033[31;1mFAILED\033[0m ] open video writer `" << path_
+                  << "'\n";
+    }
+
+    frame_t frame;
+    frame.dirty = cv::Rect (0, 0, maze.cols, maze.rows);
+    frame.patch = maze.clone ();
+    q_.push_back (std::move (frame));
+    dirty_.reserve (every_);
+
+    encoder_ = std::thread (&frame_pipeline::encode_, this);
+}
+
+void
+frame_pipeline::mark (int r, int c)
+{
+    dirty_.push_back (r * cols_ + c);
+}
+
+void
+frame_pipeline::merged (const cv::Mat &maze)
+{
+    if (++merges_ % every_ == 0)
+        snapshot_ (maze, false);
+}
+
+void
+frame_pipeline::finish (const cv::Mat &maze)
+{
+    snapshot_ (maze, true);
+
+    {
+        std::lock_guard<std::mutex> lk (mtx_);
+        done_ = true;
+    }
+    cv_.notify_all ();
+    if (encoder_.joinable ())
+        encoder_.join ();
+    writer_.release ();
+
+    if (log_level_ > 0) {
+        std::cout << "[   \033[32;1mOK\033[0m   ] write " << frames_
+                  << " frames to `" << path_ << '\'' << std::endl;
+    }
+}
+
+void
+frame_pipeline::snapshot_ (const cv::Mat &maze, bool block)
+{
+    if (dirty_.empty ())
+        return;
+
+    // only the producer pushes, so the queue cannot fill up again between
+    // this check and the push below
+    if (!block) {
+        std::lock_guard<std::mutex> lk (mtx_);
+        if ((int)q_.size () >= capacity_)
+            return;
+    }
+
+    frame_t frame;
+    frame.px.reserve (dirty_.size ());
+    for (int idx : dirty_)
+        frame.px.push_back ({ idx, maze.ptr<uchar> (idx / cols_)[idx % cols_] });
+
+    {
+        std::unique_lock<std::mutex> lk (mtx_);
+        cv_.wait (lk, [this] { return (int)q_.size () < capacity_; });
+        q_.push_back (std::move (frame));
+    }
+    cv_.notify_all ();
+
+    dirty_.clear ();
+}
+
+void
+frame_pipeline::encode_ ()
+{
+    while (true) {
+        frame_t frame;
+        {
+            std::unique_lock<std::mutex> lk (mtx_);
+            cv_.wait (lk, [this] { return done_ || !q_.empty (); });
+            if (q_.empty ())
+                break;
+
+            frame = std::move (q_.front ());
+            q_.pop_front ();
+        }
+        cv_.notify_all ();
+
+        // update the persistent frame in place
+        if (!frame.patch.empty () && shrink_ > 1) {
+            for (int i = 0; i < frame.patch.rows; ++i) {
+                const uchar *p = frame.patch.ptr<uchar> (i);
+                for (int j = 0; j < frame.patch.cols; ++j)
+                    paint_ (frame.dirty.y + i, frame.dirty.x + j, p[j]);
+            }
+        } else if (!frame.patch.empty ()) {
+            cv::Rect dst (frame.dirty.x * scale_, frame.dirty.y * scale_,
+                          frame.dirty.width * scale_,
+                          frame.dirty.height * scale_);
+            cv::Mat  roi = scaled_ (dst);
+            cv::resize (frame.patch, roi, dst.size (), 0, 0,
+                        cv::INTER_NEAREST);
+        }
+
+        for (const std::pair<int, uchar> &p : frame.px)
+            paint_ (p.first / cols_, p.first % cols_, p.second);
+
+        if (writer_.isOpened ()) {
+            writer_.write (scaled_);
+            ++frames_;
+        }
+    }
+}
+
+void
+frame_pipeline::paint_ (int r, int c, uchar v)
+{
+    if (shrink_ == 1) {
+        r = r * scale_;
+        c = c * scale_;
+        for (int i = r; i < r + scale_; ++i)
+            std::fill_n (scaled_.ptr<uchar> (i) + c, scale_, v);
+        return;
+    }
+
+    // keep the block sum current and write its mean, edge blocks may be
+    // cut short by the maze border
+    uchar *f  = full_.ptr<uchar> (r) + c;
+    int    br = r / shrink_;
+    int    bc = c / shrink_;
+    int   &s  = sums_[(size_t)br * scaled_.cols + bc];
+    s         = s + v - *f;
+    *f        = v;
+
+    int h = std::min (shrink_, full_.rows - br * shrink_);
+    int w = std::min (shrink_, full_.cols - bc * shrink_);
+    scaled_.ptr<uchar> (br)[bc] = (uchar)(s / (h * w));
+}
@@ -0,0 +1,77 @@
+#ifndef ANIMATE_HH
+#define ANIMATE_HH
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+// what changed since the previous frame: either a rectangle copied out of
+// the maze, or the individual pixels written since the last snapshot
+struct frame_t {
+    cv::Rect                            dirty;
+    cv::Mat                             patch;
+    std::vector<std::pair<int, uchar> > px; // (row * cols + col, value)
+};
+
+// snapshots the maze every `every' successful merges into a bounded queue
+// that a separate encoder thread drains into a cv::VideoWriter. `path' is a
+// video file, or a printf-style pattern such as `frames/%05d.png' for an
+// image sequence. merges land all over the grid, so frames after the first
+// carry only the written pixels instead of a dirty rectangle. when the queue
+// is full the snapshot is skipped and its pixels carried over to the next
+// one, so generation never blocks on the encoder. frames are at most
+// AN_FRAME_PX pixels on the longer side: small mazes are scaled up with
+// nearest neighbor, large ones down by averaging square blocks
+class frame_pipeline
+{
+  public:
+    frame_pipeline (const std::string &path, int every, int capacity,
+                    int log_level);
+    ~frame_pipeline ();
+
+    void start (const cv::Mat &maze);  // first full frame, starts encoder
+    void mark (int r, int c);          // pixel (r, c) was written
+    void merged (const cv::Mat &maze); // one successful merge
+    void finish (const cv::Mat &maze); // flush last frame, join encoder
+
+  private:
+    void snapshot_ (const cv::Mat &maze, bool block);
+    void encode_ ();
+    void paint_ (int r, int c, uchar v); // encoder side
+
+    std::string path_;
+    int         every_;
+    int         capacity_;
+    int         log_level_;
+    int         scale_;  // output pixels per maze pixel
+    int         shrink_; // maze pixels per output pixel
+    long long   merges_ = 0;
+
+    int cols_ = 0;
+
+    // producer side only
+    std::vector<int> dirty_;
+
+    // encoder side only. when shrinking, full_ is the maze at full size and
+    // sums_ the pixel sum of each block
+    cv::Mat          scaled_;
+    cv::Mat          full_;
+    std::vector<int> sums_;
+    cv::VideoWriter  writer_;
+    long long        frames_ = 0;
+
+    std::mutex              mtx_;
+    std::condition_variable cv_;
+    std::deque<frame_t>     q_;
+    bool                    done_ = false;
+    std::thread             encoder_;
+};
+
+#endif
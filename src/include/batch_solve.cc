@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "generate.hh"
+#include "solve.hh"
+
+// mazes solved together, one per bit of a lane word
+#define BS_LANES 64
+
+// full sweeps continue while they fill more than 1 / BS_SPARSE of the pixels,
+// after that only the neighbors of filled pixels are checked
+#define BS_SPARSE 8
+
+// clears the lanes in which pixel p has fewer than two open neighbors.
+// returns the cleared lanes
+static inline uint64_t
+fill_ (uint64_t *grid, int p, int w)
+{
+    uint64_t v = grid[p];
+    if (!v)
+        return 0;
+
+    uint64_t up = grid[p - w], down = grid[p + w];
+    uint64_t left = grid[p - 1], right = grid[p + 1];
+
+    // at least two of the four neighbors are open
+    uint64_t keep = (up & down) | (left & right)
+                    | ((up | down) & (left | right));
+    grid[p] = v & keep;
+    return v & ~keep;
+}
+
+// lanes in which pixel p is open and has an open neighbor
+static inline uint64_t
+linked_ (const uint64_t *grid, int p, int w)
+{
+    return grid[p] & (grid[p - w] | grid[p + w] | grid[p - 1] | grid[p + 1]);
+}
+
+void
+batch_solve (const std::vector<cv::Mat> &mazes, std::vector<cv::Mat> *paths,
+             std::vector<int> *lengths)
+{
+    size_t n = mazes.size ();
+    paths->assign (n, cv::Mat ());
+    lengths->assign (n, 0);
+    if (n == 0)
+        return;
+
+    int rows = mazes[0].rows;
+    int cols = mazes[0].cols;
+    for (const cv::Mat &m : mazes) {
+        if (m.depth () != CV_8U || m.channels () != 1) {
+            std::cerr << "[ \033[31;1mFAILED\033[0m ] images must be CV_8U "
+                         "with 1 channel (grayscale)\n";
+            abort ();
+        }
+
+        if (m.rows != rows || m.cols != cols) {
+            std::cerr << "[ \033[31;1mFAILED\033[0m ] images must all be "
+                      << rows << 'x' << cols << " (received " << m.rows
+                      << 'x' << m.cols << ")\n";
+            abort ();
+        }
+    }
+
+    if (rows < 3 || cols < 3)
+        return;
+
+    // structure of arrays with a one pixel wall border, so no neighbor
+    // lookup needs a bounds check
+    int                   w = cols + 2;
+    std::vector<uint64_t> grid ((size_t)(rows + 2) * w);
+    int                   entry = 1 * w + 2;           // (0, 1)
+    int                   exit  = rows * w + cols - 1; // (rows - 1, cols - 2)
+    int                   first = w + 1;
+    int                   last  = rows * w + cols;
+    std::vector<int>      work; // pixels that lost lanes, neighbors unchecked
+
+    for (size_t base = 0; base < n; base = base + BS_LANES) {
+        int lanes = (int)std::min<size_t> (BS_LANES, n - base);
+
+        // transpose one row of every maze at a time, building each lane
+        // word in a register
+        const uchar *row[BS_LANES];
+        for (int i = 0; i < rows; ++i) {
+            for (int k = 0; k < lanes; ++k)
+                row[k] = mazes[base + k].ptr<uchar> (i);
+
+            uint64_t *g = &grid[(size_t)(i + 1) * w + 1];
+            for (int j = 0; j < cols; ++j) {
+                uint64_t v = 0;
+                for (int k = 0; k < lanes; ++k)
+                    v = v | (uint64_t)(row[k][j] != GN_UC_BLK) << k;
+                g[j] = v;
+            }
+        }
+
+        // dead ends are filled in place. a full sweep shortens every dead
+        // end at once but a corridor needs one sweep per turn, so once the
+        // sweeps fill few pixels only the neighbors of the pixels filled last
+        // are checked again. the border and the entrance and exit are never
+        // filled
+        bool forward = true;
+        do {
+            work.clear ();
+            if (forward) {
+                for (int p = first; p <= last; ++p)
+                    if (p != entry && p != exit && fill_ (grid.data (), p, w))
+                        work.push_back (p);
+            } else {
+                for (int p = last; p >= first; --p)
+                    if (p != entry && p != exit && fill_ (grid.data (), p, w))
+                        work.push_back (p);
+            }
+            forward = !forward;
+        } while (work.size () * BS_SPARSE > (size_t)rows * cols);
+
+        while (!work.empty ()) {
+            int p = work.back ();
+            work.pop_back ();
+
+            const int next[4] = { p - w, p + w, p - 1, p + 1 };
+            for (int q : next)
+                if (q != entry && q != exit && fill_ (grid.data (), q, w))
+                    work.push_back (q);
+        }
+
+        // in a perfect maze without a path, filling leaves the entrance or
+        // exit with no open neighbor; those lanes report an empty path
+        uint64_t solved = linked_ (grid.data (), entry, w)
+                          & linked_ (grid.data (), exit, w);
+
+        // the open pixels left in each solved lane are that maze's path,
+        // the other lanes keep the empty mask from the assign () above
+        for (int k = 0; k < lanes; ++k)
+            if (solved >> k & 1)
+                (*paths)[base + k] = cv::Mat::zeros (rows, cols, CV_8UC1);
+
+        for (int i = 0; i < rows; ++i) {
+            const uint64_t *g = &grid[(size_t)(i + 1) * w + 1];
+            for (int j = 0; j < cols; ++j) {
+                for (uint64_t v = g[j] & solved; v; v = v & (v - 1)) {
+                    int k = __builtin_ctzll (v);
+                    (*paths)[base + k].ptr<uchar> (i)[j] = GN_UC_WHT;
+                    ++(*lengths)[base + k];
+                }
+            }
+        }
+    }
+}
@@ -4,7 +4,6 @@
 #include <cstdlib>
 #include <iostream>
 #include <random>
-#include <set>
 #include <utility>
 #include <vector>
 
@@ -12,7 +11,9 @@
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
 
+#include "animate.hh"
 #include "generate.hh"
+#include "small_maze.hh"
 
 static void
 initscan_ (cv::Mat *img, int rows, int cols)
@@ -29,9 +30,9 @@ initscan_ (cv::Mat *img, int rows, int cols)
     }
 }
 
-static void
-merge_wcond_ (cv::Mat *maze, std::set<seg_t> *sets, int rows, int cols,
-              int set_r, int set_c, int max, dir direction, int log_level)
+static bool
+merge_wcond_ (cv::Mat *maze, cellset_t *sets, int rows, int cols, int set_r,
+              int set_c, dir direction, int log_level, frame_pipeline *anim)
 {
     int idx       = set_r * cols + set_c;
     int mat_r_cur = 2 * set_r + 1;
@@ -56,7 +57,7 @@ merge_wcond_ (cv::Mat *maze, std::set<seg_t> *sets, int rows, int cols,
             std::cout << "[  \033[37;1mINFO\033[0m  ] ignored neighbor ("
                       << set_r << ',' << set_c << ")\n";
         }
-        return;
+        return false;
     }
 
     int next       = set_r * cols + set_c;
@@ -69,135 +70,167 @@ merge_wcond_ (cv::Mat *maze, std::set<seg_t> *sets, int rows, int cols,
             && in_bounds (mat_c_next, maze->cols));
 
     // if idx and next don't point to the same set (not connected in the maze)
-    seg_t cur_seg, next_seg;
-    for (seg_t seg : *sets) {
-        if (seg.ptr->count (idx))
-            cur_seg = seg;
-        if (seg.ptr->count (next))
-            next_seg = seg;
+    if (!sets->unite (idx, next)) {
+        if (log_level > 1) {
+            std::cout << "[  \033[37;1mINFO\033[0m  ] already processed "
+                      << idx << " and " << next << '\n';
+        }
+        return false;
     }
 
-    assert (cur_seg.ptr != nullptr && next_seg.ptr != nullptr);
+    // remove the wall between the two indices in the maze matrix
+    if (log_level > 1) {
+        std::cout << "[  \033[37;1mINFO\033[0m  ] write to pixel ("
+                  << (mat_r_cur + mat_r_next) / 2 << ','
+                  << (mat_c_cur + mat_c_next) / 2 << ") of " << idx << " and "
+                  << next << '\n';
+    }
 
-    if (cur_seg.ptr != next_seg.ptr) {
-        // remove the wall between the two indices in the maze matrix
-        if (log_level > 1) {
-            std::cout << "[  \033[37;1mINFO\033[0m  ] write to pixel ("
-                      << (mat_r_cur + mat_r_next) / 2 << ','
-                      << (mat_c_cur + mat_c_next) / 2 << ") of " << idx
-                      << " and " << next << '\n';
-        }
+    maze->ptr<uchar> ((mat_r_cur + mat_r_next) / 2)[(mat_c_cur + mat_c_next)
+                                                    / 2]
+        = GN_UC_WHT;
 
-        maze->ptr<uchar> ((mat_r_cur + mat_r_next)
-                          / 2)[(mat_c_cur + mat_c_next) / 2]
-            = GN_UC_WHT;
-
-        // clean up
-        cur_seg.ptr->merge (*next_seg.ptr);  // merge the sets
-        next_seg.ptr->~set ();               // destroy the old set
-        delete next_seg.ptr;                 // free the pointer to the set
-        sets->erase (sets->find (next_seg)); // erase the old set
-    } else if (log_level > 1) {
-        std::cout << "[  \033[37;1mINFO\033[0m  ] already processed " << idx
-                  << " and " << next << '\n';
+    if (anim != nullptr) {
+        anim->mark ((mat_r_cur + mat_r_next) / 2,
+                    (mat_c_cur + mat_c_next) / 2);
+        anim->merged (*maze);
     }
+
+    return true;
 }
 
 static void
-kruskal_ (cv::Mat *maze, int rows, int cols, int log_level)
+kruskal_ (cv::Mat *maze, int rows, int cols, int log_level, unsigned int seed,
+          frame_pipeline *anim)
 {
     int set_r = (rows - 1) / 2;
-    int set_c = (rows - 1) / 2;
+    int set_c = (cols - 1) / 2;
     int len   = set_r * set_c;
-    // vector of heap pointers to the sets
-    std::set<seg_t> sets;
-    for (int i = 0; i < len; ++i)
-        sets.insert ({ i, new std::set<int> ({ i }) });
-
-    // random order of traversal for the random maze
-    std::vector<std::pair<int, int> > shuffled_cells (len,
-                                                      std::pair<int, int> ());
-    for (int i = 0; i < set_r; ++i)
-        for (int j = 0; j < set_c; ++j)
-            shuffled_cells[i * set_c + j] = { i, j };
-
-    std::random_device              rd;
-    std::mt19937                    gen (rd ());
-    std::uniform_int_distribution<> r_distr (0, set_r - 1);
-    std::uniform_int_distribution<> c_distr (0, set_c - 1);
-    std::shuffle (shuffled_cells.begin (), shuffled_cells.end (),
-                  std::default_random_engine ());
-
-    // join the sets
-
-    // ------ all possible connections (n^2) ------ //
-    //
-    // for (std::pair<int, int> cell : shuffled_cells)
-    //     for (int i = 0; i < 4; ++i)
-    //         merge_wcond_ (maze, &sets, set_r, set_c, cell.first,
-    //         cell.second,
-    //                       len, (dir)i);
-
-    // ------ random ------- //
-    while (sets.size () > 1)
-        for (int i = 0; i < 4; ++i)
-            merge_wcond_ (maze, &sets, set_r, set_c, r_distr (gen),
-                          c_distr (gen), len, (dir)i, log_level);
-
-    // free the set's memory
-    delete sets.begin ()->ptr;
+
+    cellset_t sets (len);
+
+    // every wall between two cells as (cell << 1 | down), in random order for
+    // the random maze
+    std::vector<int> edges;
+    edges.reserve (2 * (size_t)len);
+    for (int i = 0; i < set_r; ++i) {
+        for (int j = 0; j < set_c; ++j) {
+            if (j + 1 < set_c)
+                edges.push_back ((i * set_c + j) << 1);
+            if (i + 1 < set_r)
+                edges.push_back ((i * set_c + j) << 1 | 1);
+        }
+    }
+
+    // join the sets in a lazily shuffled order, a spanning tree has exactly
+    // len - 1 edges. same walls and draws as small_maze<N>::generate ()
+    maze_rng_t rng (seed);
+    int        merged = 0;
+    for (size_t i = edges.size (); i > 0 && merged < len - 1; --i) {
+        size_t j = rng.below ((uint32_t)i);
+        int    e = edges[j];
+        edges[j] = edges[i - 1];
+
+        int cell = e >> 1;
+        merged   = merged
+                 + merge_wcond_ (maze, &sets, set_r, set_c, cell / set_c,
+                                 cell % set_c, e & 1 ? dir::DOWN : dir::RIGHT,
+                                 log_level, anim);
+    }
 }
 
-cv::Mat
-generate (int size, int log_level)
+static bool
+check_dim_ (const char *name, int n, int log_level)
 {
-    if (size < 3) {
+    if (n < 3) {
         if (log_level > 0) {
-            std::cerr
-                << "[ \033[31;1mFAILED\033[0m ] `size' must be at least 3 "
-                   "(received `"
-                << size << "')\n";
+            std::cerr << "[ \033[31;1mFAILED\033[0m ] `" << name
+                      << "' must be at least 3 (received `" << n << "')\n";
         }
 
         if (log_level > 1)
             abort ();
-        else
-            return cv::Mat::zeros (0, 0, CV_8UC1);
+        return false;
     }
 
-    if (!(size & 1)) {
+    if (!(n & 1)) {
         if (log_level > 0) {
-            std::cerr
-                << "[ \033[31;1mFAILED\033[0m ] `size' must be odd (recieved `"
-                << size << "')\n";
+            std::cerr << "[ \033[31;1mFAILED\033[0m ] `" << name
+                      << "' must be odd (recieved `" << n << "')\n";
         }
 
         if (log_level > 1)
             abort ();
-        else
-            return cv::Mat::zeros (0, 0, CV_8UC1);
+        return false;
+    }
+
+    return true;
+}
+
+cv::Mat
+generate (int size, int log_level)
+{
+    std::random_device rd;
+    return generate (size, log_level, rd ());
+}
+
+cv::Mat
+generate (int size, int log_level, unsigned int seed, frame_pipeline *anim)
+{
+    return generate_rect (size, size, log_level, seed, anim);
+}
+
+cv::Mat
+generate_rect (int rows, int cols, int log_level, unsigned int seed,
+               frame_pipeline *anim)
+{
+    cv::Mat maze;
+    if (!generate_rect (&maze, rows, cols, log_level, seed, anim))
+        return cv::Mat::zeros (0, 0, CV_8UC1);
+    return maze;
+}
+
+bool
+generate_rect (cv::Mat *maze, int rows, int cols, int log_level,
+               unsigned int seed, frame_pipeline *anim)
+{
+    if (!check_dim_ ("rows", rows, log_level)
+        || !check_dim_ ("cols", cols, log_level))
+        return false;
+
+    // tiny square mazes take the fixed-size path, which has no per-merge
+    // logging or animation hooks but builds the same maze for the seed
+    if (rows == cols && rows <= SM_MAX_SIZE && log_level < 2
+        && anim == nullptr) {
+        small_generate (rows, seed, maze);
+        if (log_level > 0) {
+            std::cout << "[   \033[32;1mOK\033[0m   ] finish fixed-size "
+                         "maze generation"
+                      << std::endl;
+        }
+        return true;
     }
 
-    cv::Mat maze = cv::Mat::zeros (size, size, CV_8UC1);
+    maze->create (rows, cols, CV_8UC1);
+    maze->setTo (cv::Scalar (GN_UC_BLK));
     if (log_level > 0) {
         std::cout << "[   \033[32;1mOK\033[0m   ] initialize maze matrix"
                   << std::endl;
     }
 
     // initialize the maze by creating a grid of walls
-    initscan_ (&maze, size, size);
+    initscan_ (maze, rows, cols);
     if (log_level > 0) {
         std::cout << "[   \033[32;1mOK\033[0m   ] scan maze matrix"
                   << std::endl;
     }
 
-    // cv::Mat cpy;
-    // cv::resize (maze, cpy, cv::Size (1024, 1024), 0, 0, cv::INTER_NEAREST);
-    // cv::imshow ("initscan_ output", cpy);
-    // cv::waitKey (0);
+    // first animation frame is the bare grid
+    if (anim != nullptr)
+        anim->start (*maze);
 
     // generate the maze using kruskal's algorithm to remove walls
-    kruskal_ (&maze, size, size, log_level);
+    kruskal_ (maze, rows, cols, log_level, seed, anim);
     if (log_level > 0) {
         std::cout
             << "[   \033[32;1mOK\033[0m   ] finish maze matrix generation"
@@ -205,8 +238,14 @@ generate (int size, int log_level)
     }
 
     // add start and end as the top right and bottom left, respectively
-    maze.ptr<uchar> (0)[1]                         = GN_UC_WHT;
-    maze.ptr<uchar> (maze.rows - 1)[maze.cols - 2] = GN_UC_WHT;
+    maze->ptr<uchar> (0)[1]               = GN_UC_WHT;
+    maze->ptr<uchar> (rows - 1)[cols - 2] = GN_UC_WHT;
 
-    return maze;
+    if (anim != nullptr) {
+        anim->mark (0, 1);
+        anim->mark (rows - 1, cols - 2);
+        anim->finish (*maze);
+    }
+
+    return true;
 }
@@ -1,7 +1,9 @@
 #ifndef GENERATE_H
 #define GENERATE_H
 
-#include <set>
+#include <cstdint>
+#include <utility>
+#include <vector>
 
 #include <opencv2/core.hpp>
 
@@ -10,23 +12,97 @@
 #define GN_UC_BLK         0
 #define in_bounds(n, max) (n >= 0 && n < max)
 
+class frame_pipeline;
+
 enum class dir { LEFT = 0, RIGHT = 1, UP = 2, DOWN = 3 };
-struct seg_t {
-    int            id;
-    std::set<int> *ptr;
 
+// union-find over the maze cells in row-major order, roots hold the negated
+// size of their set
+struct cellset_t {
+    std::vector<int> parent;
+
+    explicit cellset_t (int len) : parent (len, -1) {}
+
+    int
+    find (int i)
+    {
+        while (parent[i] >= 0) {
+            if (parent[parent[i]] >= 0)
+                parent[i] = parent[parent[i]]; // path halving
+            i = parent[i];
+        }
+        return i;
+    }
+
+    // false if a and b were already connected
     bool
-    operator< (const seg_t &other) const
+    unite (int a, int b)
     {
-        return id < other.id;
+        a = find (a);
+        b = find (b);
+        if (a == b)
+            return false;
+
+        // union by size
+        if (parent[a] > parent[b])
+            std::swap (a, b);
+        parent[a] = parent[a] + parent[b];
+        parent[b] = a;
+        return true;
+    }
+};
+
+// xorshift64* handing out 32 random bits per draw, two draws per word. both
+// generation paths shuffle the walls in the same order with it, so a seed
+// picks the same maze whichever path builds it
+struct maze_rng_t {
+    uint64_t state;
+    uint64_t bits = 0;
+    bool     odd  = false; // the high half of `bits' is still unused
+
+    explicit maze_rng_t (uint64_t seed) : state (seed) {}
+
+    // the next 64 bits, which below () spends low half first
+    uint64_t
+    next ()
+    {
+        uint64_t x = state + 0x9e3779b97f4a7c15ULL; // never zero
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        state = x;
+        return x * 0x2545f4914f6cdd1dULL;
+    }
+
+    // uniform in [0, n) by multiply and shift
+    uint32_t
+    below (uint32_t n)
+    {
+        if (!odd)
+            bits = next ();
+
+        uint64_t r32 = odd ? bits >> 32 : bits & 0xffffffff;
+        odd          = !odd;
+        return (uint32_t)(r32 * n >> 32);
     }
 };
 
 static void initscan_ (cv::Mat *img, int rows, int cols);
-static void merge_wcond_ (cv::Mat *maze, std::set<seg_t> *sets, int rows,
-                          int cols, int set_r, int set_c, int max,
-                          dir direction);
-static void kruskal_ (cv::Mat *maze, int rows, int cols);
+static bool merge_wcond_ (cv::Mat *maze, cellset_t *sets, int rows, int cols,
+                          int set_r, int set_c, dir direction, int log_level,
+                          frame_pipeline *anim);
+static void kruskal_ (cv::Mat *maze, int rows, int cols, int log_level,
+                      unsigned int seed, frame_pipeline *anim);
 cv::Mat     generate (int size, int log_level);
+cv::Mat     generate (int size, int log_level, unsigned int seed,
+                      frame_pipeline *anim = nullptr);
+// named apart from generate () so a rows, cols call cannot silently bind to
+// the square overload's size, log_level and seed
+cv::Mat     generate_rect (int rows, int cols, int log_level, unsigned int seed,
+                           frame_pipeline *anim = nullptr);
+// generates into `maze', reusing its buffer when it already has the size;
+// false if the dimensions are rejected
+bool        generate_rect (cv::Mat *maze, int rows, int cols, int log_level,
+                           unsigned int seed, frame_pipeline *anim = nullptr);
 
 #endif
@@ -0,0 +1,702 @@
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include "generate.hh"
+#include "server.hh"
+#include "solve.hh"
+
+#define SV_READ_CHUNK 65536
+#define SV_MAX_PIXELS (1LL << 28)
+// requests a single connection may have queued, in progress or waiting to
+// be written; the reader stops reading until the client catches up
+#define SV_MAX_INFLIGHT 64
+// seconds a socket write may stall before the client is dropped
+#define SV_SEND_TIMEOUT 5
+
+// one response waiting for the connection's writer
+struct response_t {
+    std::string        header;
+    std::vector<uchar> payload;
+};
+
+struct conn_t {
+    int                             in_fd;
+    int                             out_fd;
+    std::mutex                      mtx;
+    std::condition_variable         drained; // pending went down
+    std::condition_variable         ready;   // a response was queued or done
+    std::deque<response_t>          out;
+    std::vector<std::vector<uchar> > spare; // written payloads, for reuse
+    int                             pending = 0; // read, not yet written
+    bool                            done    = false; // reader finished
+    bool                            broken  = false; // a write failed
+};
+
+// open client sockets, shared with the detached reader threads so it outlives
+// the last of them
+struct live_t {
+    std::mutex              mtx;
+    std::condition_variable cv;
+    std::set<int>           fds;
+};
+
+struct req_t {
+    std::shared_ptr<conn_t> conn;
+    std::string             line;
+};
+
+struct work_queue_t {
+    std::mutex              mtx;
+    std::condition_variable cv;
+    std::deque<req_t>       q;
+    bool                    closed = false;
+
+    void
+    push (req_t req)
+    {
+        {
+            std::lock_guard<std::mutex> lk (mtx);
+            q.push_back (std::move (req));
+        }
+        cv.notify_one ();
+    }
+
+    bool
+    pop (req_t *req)
+    {
+        std::unique_lock<std::mutex> lk (mtx);
+        cv.wait (lk, [this] { return closed || !q.empty (); });
+        if (q.empty ())
+            return false;
+
+        *req = std::move (q.front ());
+        q.pop_front ();
+        return true;
+    }
+
+    void
+    close ()
+    {
+        {
+            std::lock_guard<std::mutex> lk (mtx);
+            closed = true;
+        }
+        cv.notify_all ();
+    }
+};
+
+// buffered reader so pipelined request lines are not read one byte at a time
+struct reader_t {
+    int         fd;
+    std::string buf;
+    size_t      pos = 0;
+
+    explicit reader_t (int fd_) : fd (fd_) {}
+
+    bool
+    fill ()
+    {
+        if (pos > 0) {
+            buf.erase (0, pos);
+            pos = 0;
+        }
+
+        size_t old = buf.size ();
+        buf.resize (old + SV_READ_CHUNK);
+        ssize_t n;
+        do
+            n = read (fd, &buf[old], SV_READ_CHUNK);
+        while (n < 0 && errno == EINTR);
+
+        buf.resize (old + (n > 0 ? n : 0));
+        return n > 0;
+    }
+
+    bool
+    getline (std::string *line)
+    {
+        while (true) {
+            size_t nl = buf.find ('\n', pos);
+            if (nl != std::string::npos) {
+                line->assign (buf, pos, nl - pos);
+                pos = nl + 1;
+                return true;
+            }
+
+            if (!fill ()) {
+                if (pos == buf.size ())
+                    return false;
+
+                // unterminated last line
+                line->assign (buf, pos, std::string::npos);
+                pos = buf.size ();
+                return true;
+            }
+        }
+    }
+
+    bool
+    read_exact (char *dst, size_t len)
+    {
+        while (len > 0) {
+            if (pos == buf.size () && !fill ())
+                return false;
+
+            size_t n = std::min (len, buf.size () - pos);
+            memcpy (dst, buf.data () + pos, n);
+            pos = pos + n;
+            dst = dst + n;
+            len = len - n;
+        }
+        return true;
+    }
+};
+
+static bool
+write_all_ (int fd, const void *data, size_t len)
+{
+    const char *p = static_cast<const char *> (data);
+    while (len > 0) {
+        ssize_t n = write (fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        p   = p + n;
+        len = len - n;
+    }
+    return true;
+}
+
+// a payload buffer the connection's writer is done with, so pipelined
+// requests of one size reuse their allocations
+static std::vector<uchar>
+spare_ (conn_t *conn)
+{
+    std::lock_guard<std::mutex> lk (conn->mtx);
+    if (conn->spare.empty ())
+        return std::vector<uchar> ();
+
+    std::vector<uchar> buf = std::move (conn->spare.back ());
+    conn->spare.pop_back ();
+    return buf;
+}
+
+// queues a response for the connection's writer, so workers never block on a
+// client that does not read
+static void
+respond_ (conn_t *conn, std::string header, std::vector<uchar> payload)
+{
+    {
+        std::lock_guard<std::mutex> lk (conn->mtx);
+        conn->out.push_back ({ std::move (header), std::move (payload) });
+    }
+    conn->ready.notify_one ();
+}
+
+static void
+respond_err_ (conn_t *conn, const std::string &id, const std::string &msg)
+{
+    respond_ (conn, id + " err " + msg + '\n', std::vector<uchar> ());
+}
+
+// per-worker images, kept warm across requests of the same size
+struct worker_buf_t {
+    cv::Mat maze;
+    cv::Mat solved;
+};
+
+// false if the line had no id to answer to
+static bool
+handle_ (conn_t *conn, const std::string &line, worker_buf_t *buf)
+{
+    std::istringstream ss (line);
+    std::string        id, op, dims, algo, fmt;
+    long long          seed = 0;
+    int                rows = 0, cols = 0;
+
+    if (!(ss >> id))
+        return false;
+
+    if (!(ss >> op >> dims >> seed >> algo >> fmt)) {
+        respond_err_ (conn, id, "malformed request");
+        return true;
+    }
+
+    // `size' or `rowsxcols'
+    int n = sscanf (dims.c_str (), "%dx%d", &rows, &cols);
+    if (n == 1)
+        cols = rows;
+    else if (n != 2) {
+        respond_err_ (conn, id, "malformed size `" + dims + '\'');
+        return true;
+    }
+
+    if (op != "gen" && op != "solve") {
+        respond_err_ (conn, id, "unknown operation `" + op + '\'');
+        return true;
+    }
+
+    if (rows < 3 || cols < 3 || !(rows & 1) || !(cols & 1)
+        || (long long)rows * cols > SV_MAX_PIXELS) {
+        respond_err_ (conn, id,
+                      "`rows' and `cols' must be odd, at least 3 and at most "
+                          + std::to_string (SV_MAX_PIXELS) + " pixels total");
+        return true;
+    }
+
+    if (algo != "kruskal") {
+        respond_err_ (conn, id, "unknown algorithm `" + algo + '\'');
+        return true;
+    }
+
+    if (fmt != "raw" && fmt != "png") {
+        respond_err_ (conn, id, "unknown format `" + fmt + '\'');
+        return true;
+    }
+
+    generate_rect (&buf->maze, rows, cols, 0, (unsigned int)seed);
+    if (op == "solve")
+        solve (buf->maze, &buf->solved);
+
+    const cv::Mat &img = op == "solve" ? buf->solved : buf->maze;
+
+    std::vector<uchar> payload = spare_ (conn);
+    if (fmt == "png") {
+        cv::imencode (".png", img, payload);
+    } else {
+        size_t row_len = img.cols * img.elemSize ();
+        payload.resize (row_len * img.rows);
+        for (int i = 0; i < img.rows; ++i)
+            memcpy (payload.data () + i * row_len, img.ptr<uchar> (i),
+                    row_len);
+    }
+
+    std::string header = id + " ok " + std::to_string (img.rows) + ' '
+                         + std::to_string (img.cols) + ' '
+                         + std::to_string (img.channels ()) + ' ' + fmt + ' '
+                         + std::to_string (payload.size ()) + '\n';
+    respond_ (conn, std::move (header), std::move (payload));
+    return true;
+}
+
+static void
+worker_ (work_queue_t *queue)
+{
+    worker_buf_t buf;
+    req_t        req;
+    while (queue->pop (&req)) {
+        conn_t *conn = req.conn.get ();
+        bool    broken;
+        {
+            std::lock_guard<std::mutex> lk (conn->mtx);
+            broken = conn->broken;
+        }
+
+        // the writer settles every queued response, the rest are settled
+        // here; a dropped client's requests are not worked on at all
+        if (broken || !handle_ (conn, req.line, &buf)) {
+            std::lock_guard<std::mutex> lk (conn->mtx);
+            --conn->pending;
+            conn->drained.notify_all ();
+        }
+        req.conn.reset ();
+    }
+}
+
+// writes queued responses in order. once a write fails or times out the
+// client is dropped: reading stops and the remaining responses are discarded
+static void
+write_conn_ (conn_t *conn)
+{
+    std::unique_lock<std::mutex> lk (conn->mtx);
+    while (true) {
+        conn->ready.wait (lk,
+                          [conn] { return conn->done || !conn->out.empty (); });
+        if (conn->out.empty ())
+            return;
+
+        response_t res = std::move (conn->out.front ());
+        conn->out.pop_front ();
+        bool broken = conn->broken;
+        lk.unlock ();
+
+        if (!broken
+            && !(write_all_ (conn->out_fd, res.header.data (),
+                             res.header.size ())
+                 && write_all_ (conn->out_fd, res.payload.data (),
+                                res.payload.size ()))) {
+            broken = true;
+            shutdown (conn->in_fd, SHUT_RD);
+        }
+        res.payload.clear ();
+
+        lk.lock ();
+        conn->broken = conn->broken || broken;
+        if ((int)conn->spare.size () < SV_MAX_INFLIGHT)
+            conn->spare.push_back (std::move (res.payload));
+        --conn->pending;
+        conn->drained.notify_all ();
+    }
+}
+
+// reads requests until eof and waits for every response to be written
+static void
+read_conn_ (std::shared_ptr<conn_t> conn, work_queue_t *queue)
+{
+    std::thread writer (write_conn_, conn.get ());
+    reader_t    r (conn->in_fd);
+    std::string line;
+    while (r.getline (&line)) {
+        if (line.empty ())
+            continue;
+
+        {
+            std::unique_lock<std::mutex> lk (conn->mtx);
+            conn->drained.wait (
+                lk, [&] { return conn->pending < SV_MAX_INFLIGHT; });
+            ++conn->pending;
+        }
+        queue->push ({ conn, line });
+    }
+
+    {
+        std::unique_lock<std::mutex> lk (conn->mtx);
+        conn->drained.wait (lk, [&] { return conn->pending == 0; });
+        conn->done = true;
+    }
+    conn->ready.notify_one ();
+    writer.join ();
+}
+
+// set from the signal handler, which also shuts the listening socket down so
+// a blocked accept () returns
+static volatile sig_atomic_t stop_      = 0;
+static volatile sig_atomic_t listen_fd_ = -1;
+
+static void
+on_stop_ (int)
+{
+    stop_ = 1;
+    if (listen_fd_ >= 0)
+        shutdown (listen_fd_, SHUT_RDWR);
+}
+
+static int
+listen_unix_ (const std::string &path, int log_level)
+{
+    sockaddr_un addr;
+    memset (&addr, 0, sizeof (addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size () >= sizeof (addr.sun_path)) {
+        if (log_level > 0) {
+            std::cerr << "[ \033[31;1mFAILED\033[0m ] socket path too long `"
+                      << path << "'\n";
+        }
+        return -1;
+    }
+    strcpy (addr.sun_path, path.c_str ());
+
+    int fd = socket (AF_UNIX, SOCK_STREAM, 0);
+    unlink (path.c_str ());
+    if (fd < 0 || bind (fd, (sockaddr *)&addr, sizeof (addr)) < 0
+        || listen (fd, 64) < 0) {
+        if (log_level > 0) {
+            std::cerr << "[ \033[31;1mFAILED\033[0m ] listen on `" << path
+                      << "': " << strerror (errno) << '\n';
+        }
+        if (fd >= 0)
+            close (fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static int
+connect_unix_ (const std::string &path, int log_level)
+{
+    sockaddr_un addr;
+    memset (&addr, 0, sizeof (addr));
+    addr.sun_family = AF_UNIX;
+    strncpy (addr.sun_path, path.c_str (), sizeof (addr.sun_path) - 1);
+
+    int fd = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect (fd, (sockaddr *)&addr, sizeof (addr)) < 0) {
+        if (log_level > 0) {
+            std::cerr << "[ \033[31;1mFAILED\033[0m ] connect to `" << path
+                      << "': " << strerror (errno) << '\n';
+        }
+        if (fd >= 0)
+            close (fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+int
+serve (const std::string &path, int workers, int log_level)
+{
+    signal (SIGPIPE, SIG_IGN);
+
+    if (workers < 1)
+        workers = std::max (1u, std::thread::hardware_concurrency ());
+
+    work_queue_t             queue;
+    std::vector<std::thread> pool;
+    for (int i = 0; i < workers; ++i)
+        pool.emplace_back (worker_, &queue);
+
+    // logs go to stderr so they never interleave with stdout responses
+    if (log_level > 0) {
+        std::cerr << "[   \033[32;1mOK\033[0m   ] start " << workers
+                  << " workers" << std::endl;
+    }
+
+    int ret = 0;
+    if (path == "-") {
+        auto conn    = std::make_shared<conn_t> ();
+        conn->in_fd  = STDIN_FILENO;
+        conn->out_fd = STDOUT_FILENO;
+        read_conn_ (conn, &queue);
+    } else {
+        int lfd = listen_unix_ (path, log_level);
+        if (lfd < 0) {
+            ret = 1;
+        } else {
+            if (log_level > 0) {
+                std::cerr << "[   \033[32;1mOK\033[0m   ] listen on `" << path
+                          << '\'' << std::endl;
+            }
+
+            auto live = std::make_shared<live_t> ();
+
+            // stop accepting on SIGINT/SIGTERM so the socket file is removed
+            listen_fd_ = lfd;
+            signal (SIGINT, on_stop_);
+            signal (SIGTERM, on_stop_);
+
+            while (true) {
+                int fd = accept (lfd, nullptr, nullptr);
+                if (fd >= 0 && stop_) {
+                    close (fd);
+                    fd = -1;
+                }
+                if (fd < 0) {
+                    if (stop_) {
+                        if (log_level > 0) {
+                            std::cerr << "[  \033[37;1mINFO\033[0m  ] stop "
+                                         "listening on `"
+                                      << path << '\'' << std::endl;
+                        }
+                        break;
+                    }
+                    if (errno == EINTR || errno == ECONNABORTED)
+                        continue;
+                    if (log_level > 0) {
+                        std::cerr << "[ \033[31;1mFAILED\033[0m ] accept: "
+                                  << strerror (errno) << '\n';
+                    }
+                    ret = 1;
+                    break;
+                }
+
+                if (log_level > 1) {
+                    std::cerr << "[  \033[37;1mINFO\033[0m  ] accept client "
+                              << fd << std::endl;
+                }
+
+                // a client that stops reading is dropped instead of
+                // stalling its writer forever
+                timeval tv = { SV_SEND_TIMEOUT, 0 };
+                setsockopt (fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof (tv));
+
+                auto conn    = std::make_shared<conn_t> ();
+                conn->in_fd  = fd;
+                conn->out_fd = fd;
+                {
+                    std::lock_guard<std::mutex> lk (live->mtx);
+                    live->fds.insert (fd);
+                }
+
+                // the fd leaves the set before it is closed, so serve ()
+                // never shuts down a reused descriptor
+                std::thread ([conn, fd, &queue, live] {
+                    read_conn_ (conn, &queue);
+                    {
+                        std::lock_guard<std::mutex> lk (live->mtx);
+                        live->fds.erase (fd);
+                        live->cv.notify_all ();
+                    }
+                    close (fd);
+                }).detach ();
+            }
+
+            // wake up any remaining readers and let them drain
+            std::unique_lock<std::mutex> lk (live->mtx);
+            for (int fd : live->fds)
+                shutdown (fd, SHUT_RD);
+            live->cv.wait (lk, [&] { return live->fds.empty (); });
+            lk.unlock ();
+
+            signal (SIGINT, SIG_DFL);
+            signal (SIGTERM, SIG_DFL);
+            listen_fd_ = -1;
+
+            close (lfd);
+            unlink (path.c_str ());
+        }
+    }
+
+    queue.close ();
+    for (std::thread &t : pool)
+        t.join ();
+
+    return ret;
+}
+
+int
+loadgen (const std::string &path, const std::string &op,
+         const std::string &fmt, int rows, int cols, int requests,
+         int depth, int log_level)
+{
+    typedef std::chrono::steady_clock clk;
+
+    signal (SIGPIPE, SIG_IGN);
+
+    if (requests < 1 || depth < 1) {
+        if (log_level > 0) {
+            std::cerr << "[ \033[31;1mFAILED\033[0m ] `requests' and `depth' "
+                         "must be positive\n";
+        }
+        return 1;
+    }
+
+    std::string dims = std::to_string (rows) + 'x' + std::to_string (cols);
+
+    int fd = connect_unix_ (path, log_level);
+    if (fd < 0)
+        return 1;
+
+    std::vector<clk::time_point> sent (requests);
+    std::vector<double>          lat (requests, -1.0);
+    std::mutex                   mtx;
+    std::condition_variable      cv;
+    int                          inflight = 0;
+    int                          errors   = 0;
+    long long                    bytes    = 0;
+
+    std::thread rx ([&] {
+        reader_t          r (fd);
+        std::string       line;
+        std::vector<char> sink;
+        for (int got = 0; got < requests; ++got) {
+            if (!r.getline (&line))
+                break;
+
+            std::istringstream ss (line);
+            std::string        status, rfmt;
+            int                id = -1, rows, cols, ch;
+            size_t             nbytes = 0;
+            ss >> id >> status;
+            if (status == "ok") {
+                ss >> rows >> cols >> ch >> rfmt >> nbytes;
+                sink.resize (nbytes);
+                if (!r.read_exact (sink.data (), nbytes))
+                    break;
+            }
+
+            clk::time_point now = clk::now ();
+            {
+                std::lock_guard<std::mutex> lk (mtx);
+                if (status != "ok" || id < 0 || id >= requests) {
+                    ++errors;
+                } else {
+                    lat[id] = std::chrono::duration<double, std::micro> (
+                                  now - sent[id])
+                                  .count ();
+                    bytes = bytes + nbytes;
+                }
+                --inflight;
+            }
+            cv.notify_one ();
+        }
+
+        // unblock the sender if the server went away
+        std::lock_guard<std::mutex> lk (mtx);
+        inflight = -requests;
+        cv.notify_one ();
+    });
+
+    clk::time_point start = clk::now ();
+    for (int i = 0; i < requests; ++i) {
+        std::string req = std::to_string (i) + ' ' + op + ' ' + dims + ' '
+                          + std::to_string (i) + " kruskal " + fmt + '\n';
+        {
+            std::unique_lock<std::mutex> lk (mtx);
+            cv.wait (lk, [&] { return inflight < depth; });
+            if (inflight < 0)
+                break;
+            ++inflight;
+            sent[i] = clk::now ();
+        }
+
+        if (!write_all_ (fd, req.data (), req.size ()))
+            break;
+    }
+
+    rx.join ();
+    close (fd);
+
+    double secs = std::chrono::duration<double> (clk::now () - start).count ();
+
+    std::vector<double> done;
+    for (double l : lat)
+        if (l >= 0)
+            done.push_back (l);
+    std::sort (done.begin (), done.end ());
+
+    if (log_level > 0) {
+        std::cout << "[  \033[37;1mINFO\033[0m  ] " << done.size () << '/'
+                  << requests << " ok, " << errors << " errors, depth "
+                  << depth << ", " << secs << " s\n";
+        std::cout << "[  \033[37;1mINFO\033[0m  ] throughput "
+                  << done.size () / secs << " req/s, "
+                  << bytes / secs / (1 << 20) << " MiB/s\n";
+        if (!done.empty ()) {
+            auto pct = [&] (double p) {
+                return done[std::min (done.size () - 1,
+                                      (size_t)(p * done.size ()))];
+            };
+            std::cout << "[  \033[37;1mINFO\033[0m  ] latency (us) p50 "
+                      << pct (0.50) << ", p90 " << pct (0.90) << ", p99 "
+                      << pct (0.99) << ", max " << done.back () << std::endl;
+        }
+    }
+
+    return (int)done.size () == requests ? 0 : 1;
+}
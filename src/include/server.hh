@@ -0,0 +1,21 @@
+#ifndef SERVER_HH
+#define SERVER_HH
+
+#include <string>
+
+// request line (one per line, may be pipelined):
+//   <id> <gen|solve> <size | rows x cols> <seed> <algorithm> <raw|png>
+// response (may arrive out of order, matched by id):
+//   <id> ok <rows> <cols> <channels> <raw|png> <nbytes>\n<nbytes of payload>
+//   <id> err <message>\n
+//
+// `path' is the unix socket to listen on, or "-" for stdin/stdout
+int serve (const std::string &path, int workers, int log_level);
+
+// pipelined client that keeps up to `depth' requests in flight and reports
+// throughput and latency percentiles
+int loadgen (const std::string &path, const std::string &op,
+             const std::string &fmt, int rows, int cols, int requests,
+             int depth, int log_level);
+
+#endif
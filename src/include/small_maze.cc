@@ -0,0 +1,75 @@
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <utility>
+
+#include <opencv2/core.hpp>
+
+#include "small_maze.hh"
+
+#define SM_COUNT ((SM_MAX_SIZE - 3) / 2 + 1)
+
+template <int N>
+static void
+small_generate_ (unsigned int seed, cv::Mat *maze)
+{
+    small_maze<N> m;
+    m.generate (seed);
+    small_maze<N>::to_mat (m.open, maze);
+}
+
+template <int N>
+static void
+small_solve_ (const cv::Mat &maze, cv::Mat *path, int *len)
+{
+    small_maze<N>                      m;
+    std::bitset<small_maze<N>::PIXELS> bits;
+    m.from_mat (maze);
+    *len = m.solve (&bits);
+    small_maze<N>::to_mat (bits, path);
+}
+
+typedef void (*gen_fn_t) (unsigned int, cv::Mat *);
+typedef void (*solve_fn_t) (const cv::Mat &, cv::Mat *, int *);
+
+// entry i handles size 2 * i + 3
+template <std::size_t... I>
+static constexpr std::array<gen_fn_t, sizeof...(I)>
+gen_table_ (std::index_sequence<I...>)
+{
+    return { { &small_generate_<2 * I + 3>... } };
+}
+
+template <std::size_t... I>
+static constexpr std::array<solve_fn_t, sizeof...(I)>
+solve_table_ (std::index_sequence<I...>)
+{
+    return { { &small_solve_<2 * I + 3>... } };
+}
+
+static constexpr std::array<gen_fn_t, SM_COUNT> gen_fns_
+    = gen_table_ (std::make_index_sequence<SM_COUNT> ());
+static constexpr std::array<solve_fn_t, SM_COUNT> solve_fns_
+    = solve_table_ (std::make_index_sequence<SM_COUNT> ());
+
+bool
+small_generate (int size, unsigned int seed, cv::Mat *maze)
+{
+    if (size < 3 || size > SM_MAX_SIZE || !(size & 1))
+        return false;
+
+    gen_fns_[(size - 3) / 2](seed, maze);
+    return true;
+}
+
+bool
+small_solve (const cv::Mat &maze, cv::Mat *path, int *len)
+{
+    if (maze.rows != maze.cols || maze.rows < 3 || maze.rows > SM_MAX_SIZE
+        || !(maze.rows & 1) || maze.depth () != CV_8U
+        || maze.channels () != 1)
+        return false;
+
+    solve_fns_[(maze.rows - 3) / 2](maze, path, len);
+    return true;
+}
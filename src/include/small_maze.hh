@@ -0,0 +1,245 @@
+#ifndef SMALL_MAZE_HH
+#define SMALL_MAZE_HH
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <utility>
+
+#include <opencv2/core.hpp>
+
+#include "generate.hh"
+
+// largest square maze handled by the fixed-size kernels
+#define SM_MAX_SIZE 63
+
+// an N x N maze with its size known at compile time. everything lives in
+// fixed arrays on the stack, so small mazes skip the cv::Mat allocation and
+// the runtime-sized loops of generate () and only convert on request
+template <int N> struct small_maze {
+    static_assert (N >= 3 && (N & 1), "size must be odd and at least 3");
+    static_assert (N <= 255, "pixel indices must fit in 16 bits");
+
+    static constexpr int C      = (N - 1) / 2;     // cells per side
+    static constexpr int CELLS  = C * C;
+    static constexpr int EDGES  = 2 * C * (C - 1); // walls between cells
+    static constexpr int PIXELS = N * N;
+    static constexpr int ENTRY  = 1;               // (0, 1)
+    static constexpr int EXIT   = PIXELS - 2;      // (N - 1, N - 2)
+
+    // the two cells a wall separates and the wall's own pixel
+    struct wall_t {
+        uint16_t a, b, px;
+    };
+
+    std::bitset<PIXELS> open;
+
+    // randomized kruskal over a shuffled copy of the wall table. the sets are
+    // kept as quick-find labels, each a circular list through `next', so a
+    // rejected wall costs two loads instead of two root walks, and a merge
+    // relabels the smaller set
+    void
+    generate (uint64_t seed)
+    {
+        static_assert (EDGES % 2 == 0, "draws are taken in pairs");
+
+        const std::array<wall_t, EDGES> &walls = wall_table_ ();
+        std::array<uint16_t, EDGES>       order = order_table_ ();
+        std::array<uint16_t, CELLS>       label, next, size;
+        for (int i = 0; i < CELLS; ++i) {
+            label[i] = i;
+            next[i]  = i;
+            size[i]  = 1;
+        }
+
+        open = cell_grid_ ();
+        open[ENTRY] = true;
+        open[EXIT]  = true;
+
+        int  left = CELLS - 1;
+        auto take = [&] (int i, uint64_t r32) {
+            int j = (int)(r32 * (uint64_t)(i + 1) >> 32);
+
+            const wall_t &w = walls[order[j]];
+            order[j]        = order[i];
+
+            int set_a = label[w.a];
+            int set_b = label[w.b];
+            if (set_a == set_b)
+                return;
+            if (size[set_a] < size[set_b])
+                std::swap (set_a, set_b);
+
+            int p = set_b;
+            do {
+                label[p] = set_a;
+                p        = next[p];
+            } while (p != set_b);
+            std::swap (next[set_a], next[set_b]);
+            size[set_a] += size[set_b];
+            --left;
+
+            open[w.px] = true;
+        };
+
+        // fisher-yates, drawing each edge as it is needed. the wall table
+        // and the draws match rng.below () in kruskal_ (), two per word
+        maze_rng_t rng (seed);
+        for (int i = EDGES - 1; i > 0 && left > 0; i = i - 2) {
+            uint64_t bits = rng.next ();
+            take (i, bits & 0xffffffff);
+            if (left > 0)
+                take (i - 1, bits >> 32);
+        }
+    }
+
+    // breadth first search from the entrance to the exit. writes the path
+    // pixels to `path' and returns their count, or 0 if there is no path
+    int
+    solve (std::bitset<PIXELS> *path) const
+    {
+        std::array<uint16_t, PIXELS> queue;
+        std::array<uint16_t, PIXELS> prev;
+        std::bitset<PIXELS>          seen;
+
+        int head = 0, tail = 0;
+        queue[tail++] = ENTRY;
+        seen[ENTRY] = true;
+
+        while (head < tail && !seen[EXIT]) {
+            int p = queue[head++];
+            int r = p / N;
+            int c = p % N;
+
+            if (r > 0 && open[p - N] && !seen[p - N]) {
+                seen[p - N] = true;
+                prev[p - N]   = p;
+                queue[tail++] = p - N;
+            }
+            if (r < N - 1 && open[p + N] && !seen[p + N]) {
+                seen[p + N] = true;
+                prev[p + N]   = p;
+                queue[tail++] = p + N;
+            }
+            if (c > 0 && open[p - 1] && !seen[p - 1]) {
+                seen[p - 1] = true;
+                prev[p - 1]   = p;
+                queue[tail++] = p - 1;
+            }
+            if (c < N - 1 && open[p + 1] && !seen[p + 1]) {
+                seen[p + 1] = true;
+                prev[p + 1]   = p;
+                queue[tail++] = p + 1;
+            }
+        }
+
+        path->reset ();
+        if (!seen[EXIT])
+            return 0;
+
+        int len = 1;
+        (*path)[ENTRY] = true;
+        for (int p = EXIT; p != ENTRY; p = prev[p]) {
+            (*path)[p] = true;
+            ++len;
+        }
+        return len;
+    }
+
+    void
+    from_mat (const cv::Mat &mat)
+    {
+        CV_Assert (mat.rows == N && mat.cols == N && mat.depth () == CV_8U
+                   && mat.channels () == 1);
+
+        open.reset ();
+        for (int i = 0; i < N; ++i) {
+            const uchar *p = mat.ptr<uchar> (i);
+            for (int j = 0; j < N; ++j)
+                if (p[j] != GN_UC_BLK)
+                    open[i * N + j] = true;
+        }
+    }
+
+    // writes into `mat', reusing its buffer when it is already N x N
+    static void
+    to_mat (const std::bitset<PIXELS> &bits, cv::Mat *mat)
+    {
+        mat->create (N, N, CV_8UC1);
+        for (int i = 0; i < N; ++i) {
+            uchar *p = mat->ptr<uchar> (i);
+            for (int j = 0; j < N; ++j)
+                p[j] = bits[i * N + j] ? GN_UC_WHT : GN_UC_BLK;
+        }
+    }
+
+    cv::Mat
+    to_mat () const
+    {
+        cv::Mat mat;
+        to_mat (open, &mat);
+        return mat;
+    }
+
+  private:
+    // every wall between two cells, built once per size
+    static const std::array<wall_t, EDGES> &
+    wall_table_ ()
+    {
+        static const std::array<wall_t, EDGES> table = [] {
+            std::array<wall_t, EDGES> t{};
+            int                       k = 0;
+            for (int i = 0; i < C; ++i) {
+                for (int j = 0; j < C; ++j) {
+                    int px = (2 * i + 1) * N + 2 * j + 1;
+                    if (j + 1 < C)
+                        t[k++] = { (uint16_t)(i * C + j),
+                                   (uint16_t)(i * C + j + 1),
+                                   (uint16_t)(px + 1) };
+                    if (i + 1 < C)
+                        t[k++] = { (uint16_t)(i * C + j),
+                                   (uint16_t)((i + 1) * C + j),
+                                   (uint16_t)(px + N) };
+                }
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    static const std::array<uint16_t, EDGES> &
+    order_table_ ()
+    {
+        static const std::array<uint16_t, EDGES> table = [] {
+            std::array<uint16_t, EDGES> t{};
+            for (int i = 0; i < EDGES; ++i)
+                t[i] = i;
+            return t;
+        }();
+        return table;
+    }
+
+    // the initscan_ grid: every cell open, every wall closed
+    static const std::bitset<PIXELS> &
+    cell_grid_ ()
+    {
+        static const std::bitset<PIXELS> grid = [] {
+            std::bitset<PIXELS> g;
+            for (int i = 1; i < N; i = i + 2)
+                for (int j = 1; j < N; j = j + 2)
+                    g[i * N + j] = true;
+            return g;
+        }();
+        return grid;
+    }
+};
+
+// fixed-size generation into `maze' for odd sizes up to SM_MAX_SIZE, false
+// for any other size
+bool small_generate (int size, unsigned int seed, cv::Mat *maze);
+
+// fixed-size breadth first search; false if `maze' is not a square of an odd
+// size up to SM_MAX_SIZE. `path' gets the solution pixels as GN_UC_WHT
+bool small_solve (const cv::Mat &maze, cv::Mat *path, int *len);
+
+#endif
@@ -0,0 +1,43 @@
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "generate.hh"
+#include "small_maze.hh"
+#include "solve.hh"
+
+cv::Mat
+solve (const cv::Mat &maze)
+{
+    cv::Mat dst;
+    solve (maze, &dst);
+    return dst;
+}
+
+void
+solve (const cv::Mat &maze, cv::Mat *dst)
+{
+    cv::Mat path;
+    int     len;
+    if (!small_solve (maze, &path, &len)) {
+        std::vector<cv::Mat> paths;
+        std::vector<int>     lens;
+        batch_solve ({ maze }, &paths, &lens);
+        path = paths[0];
+    }
+
+    // gray maze with the route pixels in red, an unsolvable maze stays gray
+    dst->create (maze.rows, maze.cols, CV_8UC3);
+    for (int i = 0; i < maze.rows; ++i) {
+        const uchar *m = maze.ptr<uchar> (i);
+        const uchar *p = path.empty () ? nullptr : path.ptr<uchar> (i);
+        uchar       *d = dst->ptr<uchar> (i);
+        for (int j = 0; j < maze.cols; ++j) {
+            bool on = p != nullptr && p[j] != GN_UC_BLK;
+
+            d[3 * j]     = on ? 0 : m[j];
+            d[3 * j + 1] = on ? 0 : m[j];
+            d[3 * j + 2] = on ? GN_UC_WHT : m[j];
+        }
+    }
+}
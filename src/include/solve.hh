@@ -1,8 +1,24 @@
 #ifndef SOLVE_HH
 #define SOLVE_HH
 
+#include <vector>
+
 #include <opencv2/core.hpp>
 
 cv::Mat cv_morph_solve (cv::Mat src);
 
+// solves a perfect maze into a BGR image with the route pixels drawn in red.
+// square mazes up to SM_MAX_SIZE take the fixed-size breadth first search and
+// anything else batch_solve (), so the drawing is the same at every size
+cv::Mat solve (const cv::Mat &maze);
+// same, drawing into `dst' and reusing its buffer when the size matches
+void    solve (const cv::Mat &maze, cv::Mat *dst);
+
+// solves perfect mazes of identical size in lockstep by dead-end filling, one
+// bit per maze in each 64-bit lane word. `paths' gets a CV_8UC1 mask per maze
+// with the solution pixels set, `lengths' the number of those pixels (0 and
+// an empty mask when the entrance and exit are not connected)
+void batch_solve (const std::vector<cv::Mat> &mazes,
+                  std::vector<cv::Mat> *paths, std::vector<int> *lengths);
+
 #endif
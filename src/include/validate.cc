@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "generate.hh"
+#include "validate.hh"
+
+// rows handed to each thread at minimum, below this spawning costs more than
+// the scan itself
+#define VL_MIN_BAND 64
+
+// per-band tallies, merged after the threads join
+struct band_t {
+    long long pixels = 0;
+    long long edges  = 0;
+    long long border = 0;
+    long long closed = 0;
+    long long merges = 0; // successful unions, each removes one region
+};
+
+// pixel indices are int while they fit and long long past INT_MAX pixels,
+// so ordinary mazes keep the smaller parent array
+template <typename idx_t>
+static idx_t
+find_ (idx_t *parent, idx_t p)
+{
+    while (parent[p] != p) {
+        parent[p] = parent[parent[p]]; // path halving
+        p         = parent[p];
+    }
+    return p;
+}
+
+template <typename idx_t>
+static bool
+union_ (idx_t *parent, idx_t a, idx_t b)
+{
+    a = find_ (parent, a);
+    b = find_ (parent, b);
+    if (a == b)
+        return false;
+
+    // keep the smaller index as the root so roots stay inside the band that
+    // owns them
+    if (a < b)
+        parent[b] = a;
+    else
+        parent[a] = b;
+    return true;
+}
+
+// unions every open pixel in rows [r0, r1) with its left and upper
+// neighbors inside the band; touches only parent entries of the band
+template <typename idx_t>
+static void
+scan_band_ (const cv::Mat *maze, idx_t *parent, int r0, int r1, band_t *out)
+{
+    int rows = maze->rows;
+    int cols = maze->cols;
+
+    for (int i = r0; i < r1; ++i) {
+        const uchar *p      = maze->ptr<uchar> (i);
+        const uchar *up     = i > r0 ? maze->ptr<uchar> (i - 1) : nullptr;
+        bool         edge_r = i == 0 || i == rows - 1;
+
+        for (int j = 0; j < cols; ++j) {
+            idx_t idx = (idx_t)i * cols + j;
+
+            if (p[j] == GN_UC_BLK) {
+                if (i & j & 1)
+                    ++out->closed;
+                continue;
+            }
+
+            parent[idx] = idx;
+            ++out->pixels;
+
+            if ((edge_r || j == 0 || j == cols - 1) && !(i == 0 && j == 1)
+                && !(i == rows - 1 && j == cols - 2))
+                ++out->border;
+
+            if (j > 0 && p[j - 1] != GN_UC_BLK) {
+                out->merges = out->merges + union_ (parent, idx - 1, idx);
+                ++out->edges;
+            }
+
+            if (up != nullptr && up[j] != GN_UC_BLK) {
+                out->merges = out->merges + union_ (parent, idx - cols, idx);
+                ++out->edges;
+            }
+        }
+    }
+}
+
+template <typename idx_t>
+static maze_report_t
+validate_ (const cv::Mat &maze, int threads)
+{
+    maze_report_t rep = { 0, 0, 0, 0, false, false };
+    int           rows = maze.rows;
+    int           cols = maze.cols;
+
+    if (threads < 1)
+        threads = std::max (1u, std::thread::hardware_concurrency ());
+    threads = std::max (1, std::min (threads, rows / VL_MIN_BAND));
+
+    std::vector<idx_t>  parent ((size_t)rows * cols, -1);
+    std::vector<band_t> bands (threads);
+    std::vector<int>    starts (threads + 1);
+    for (int t = 0; t <= threads; ++t)
+        starts[t] = (int)((long long)rows * t / threads);
+
+    if (threads == 1) {
+        scan_band_ (&maze, parent.data (), 0, rows, &bands[0]);
+    } else {
+        std::vector<std::thread> pool;
+        for (int t = 0; t < threads; ++t)
+            pool.emplace_back (scan_band_<idx_t>, &maze, parent.data (),
+                               starts[t], starts[t + 1], &bands[t]);
+        for (std::thread &th : pool)
+            th.join ();
+    }
+
+    band_t total;
+    for (const band_t &b : bands) {
+        total.pixels = total.pixels + b.pixels;
+        total.edges  = total.edges + b.edges;
+        total.border = total.border + b.border;
+        total.closed = total.closed + b.closed;
+        total.merges = total.merges + b.merges;
+    }
+
+    // stitch vertically adjacent rows that straddle a band boundary
+    for (int t = 1; t < threads; ++t) {
+        int          i  = starts[t];
+        const uchar *up = maze.ptr<uchar> (i - 1);
+        const uchar *p  = maze.ptr<uchar> (i);
+        for (int j = 0; j < cols; ++j) {
+            if (up[j] != GN_UC_BLK && p[j] != GN_UC_BLK) {
+                total.merges = total.merges
+                               + union_ (parent.data (),
+                                         (idx_t)(i - 1) * cols + j,
+                                         (idx_t)i * cols + j);
+                ++total.edges;
+            }
+        }
+    }
+
+    // every pixel starts as its own region
+    long long regions = total.pixels - total.merges;
+
+    rep.entrance_open = maze.ptr<uchar> (0)[1] != GN_UC_BLK;
+    rep.exit_open     = maze.ptr<uchar> (rows - 1)[cols - 2] != GN_UC_BLK;
+    rep.cycles        = total.edges - total.pixels + regions;
+    rep.isolated      = regions - (rep.entrance_open ? 1 : 0);
+    rep.broken_border = total.border;
+    rep.closed_cells  = total.closed;
+
+    return rep;
+}
+
+maze_report_t
+validate (const cv::Mat &maze, int threads)
+{
+    CV_Assert (maze.depth () == CV_8U && maze.channels () == 1);
+
+    if (maze.rows < 2 || maze.cols < 2)
+        return { 0, 0, 0, 0, false, false };
+
+    if ((long long)maze.rows * maze.cols > INT_MAX)
+        return validate_<long long> (maze, threads);
+    return validate_<int> (maze, threads);
+}
+
+open_tally_t::open_tally_t (int rows_, int cols_)
+    : rows (rows_), cols (cols_), open ((size_t)rows_ * cols_, 0)
+{
+}
+
+void
+open_tally_t::add (const cv::Mat &maze)
+{
+    CV_Assert (maze.rows == rows && maze.cols == cols
+               && maze.depth () == CV_8U && maze.channels () == 1);
+
+    for (int i = 0; i < rows; ++i) {
+        const uchar *p = maze.ptr<uchar> (i);
+        int         *o = &open[(size_t)i * cols];
+        for (int j = 0; j < cols; ++j)
+            o[j] = o[j] + (p[j] != GN_UC_BLK);
+    }
+    ++samples;
+}
+
+int
+open_tally_t::skewed (double z, cv::Point *a, cv::Point *b) const
+{
+    int    count = 0;
+    double worst = -1.0;
+
+    // |n_p - n_q| / sqrt (n_p + n_q) bounds the deviation from above, since
+    // the variance of the difference is at most the chance either is open
+    auto check = [&] (int i, int j, int k, int l) {
+        long long np = open[(size_t)i * cols + j];
+        long long nq = open[(size_t)k * cols + l];
+        if (np + nq == 0)
+            return;
+
+        double dev = std::abs (np - nq) / std::sqrt ((double)(np + nq));
+        if (dev > z)
+            ++count;
+        if (dev > worst) {
+            worst = dev;
+            *a    = cv::Point (j, i);
+            *b    = cv::Point (l, k);
+        }
+    };
+
+    // interior wall pixels are the ones with exactly one odd coordinate;
+    // visit each pair once from its first pixel in row-major order
+    for (int i = 1; i < rows - 1; ++i) {
+        for (int j = 1 + (i & 1); j < cols - 1; j = j + 2) {
+            int hi = rows - 1 - i, hj = cols - 1 - j;
+            if ((long long)i * cols + j < (long long)hi * cols + hj)
+                check (i, j, hi, hj);
+            if (rows == cols && i < j)
+                check (i, j, j, i);
+        }
+    }
+
+    return count;
+}
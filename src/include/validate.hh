@@ -0,0 +1,53 @@
+#ifndef VALIDATE_HH
+#define VALIDATE_HH
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+// standard deviations past which open_tally_t::skewed () counts a wall pair,
+// high enough that the thousands of pairs of a large maze stay quiet
+#define VL_SKEW_Z 5.0
+
+// invariants of a perfect maze, counted over the open (non-black) pixels of
+// the image using 4-connectivity
+struct maze_report_t {
+    long long cycles;        // independent cycles (edges - pixels + regions)
+    long long isolated;      // open regions not connected to the entrance
+    long long broken_border; // open border pixels besides entrance and exit
+    long long closed_cells;  // odd (row, col) cell pixels that are walls
+    bool      entrance_open; // (0, 1)
+    bool      exit_open;     // (rows - 1, cols - 2)
+
+    bool
+    ok () const
+    {
+        return cycles == 0 && isolated == 0 && broken_border == 0
+               && closed_cells == 0 && entrance_open && exit_open;
+    }
+};
+
+// linear in the number of pixels; `threads' < 1 picks one per core
+maze_report_t validate (const cv::Mat &maze, int threads);
+
+// how often each pixel is open over many mazes of one size. validate () only
+// sees one maze at a time, so a generator that always opens the same wall
+// still passes it; the tally catches that by comparing each wall with its
+// mirror images, which a fair generator opens about equally often
+struct open_tally_t {
+    int              rows;
+    int              cols;
+    int              samples = 0;
+    std::vector<int> open;
+
+    open_tally_t (int rows_, int cols_);
+
+    void add (const cv::Mat &maze);
+
+    // number of wall pairs (under a half turn and, for square mazes, a
+    // transpose) whose open counts differ by more than `z' standard
+    // deviations. the most lopsided pair goes to `a' and `b'
+    int skewed (double z, cv::Point *a, cv::Point *b) const;
+};
+
+#endif
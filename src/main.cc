@@ -1,15 +1,22 @@
 #include <getopt.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <iostream>
+#include <random>
+#include <string>
 
 #include <opencv2/core.hpp>
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
 
+#include "include/animate.hh"
 #include "include/generate.hh"
+#include "include/server.hh"
 #include "include/solve.hh"
+#include "include/validate.hh"
 
 static int log_level = 1;
 
@@ -17,12 +24,31 @@ static struct option opts[] = { { "verbose", no_argument, &log_level, 2 },
                                 { "brief", no_argument, &log_level, 1 },
                                 { "silent", no_argument, &log_level, 0 },
                                 { "size", required_argument, 0, 'S' },
+                                { "rows", required_argument, 0, 'R' },
+                                { "cols", required_argument, 0, 'C' },
+                                { "serve", required_argument, 0, 'L' },
+                                { "workers", required_argument, 0, 'W' },
+                                { "loadgen", required_argument, 0, 'G' },
+                                { "requests", required_argument, 0, 'N' },
+                                { "depth", required_argument, 0, 'D' },
+                                { "op", required_argument, 0, 'O' },
+                                { "format", required_argument, 0, 'F' },
+                                { "validate", required_argument, 0, 'V' },
+                                { "anim", required_argument, 0, 'A' },
+                                { "anim-every", required_argument, 0, 'K' },
                                 { 0, 0, 0, 0 } };
 
 int
 main (int argc, char **argv)
 {
-    int size = -1;
+    int size = -1, rows = -1, cols = -1;
+
+    std::string serve_path, loadgen_path;
+    std::string op = "gen", fmt = "raw";
+    int         workers = 0, requests = 1000, depth = 16;
+    int         validate_n = 0;
+    std::string anim_path;
+    int         anim_every = 0;
 
     int opt;
     while (true) {
@@ -45,20 +71,132 @@ main (int argc, char **argv)
             case 'S':
                 size = std::stoi (optarg);
                 break;
+            case 'R':
+                rows = std::stoi (optarg);
+                break;
+            case 'C':
+                cols = std::stoi (optarg);
+                break;
+            case 'L':
+                serve_path = optarg;
+                break;
+            case 'W':
+                workers = std::stoi (optarg);
+                break;
+            case 'G':
+                loadgen_path = optarg;
+                break;
+            case 'N':
+                requests = std::stoi (optarg);
+                break;
+            case 'D':
+                depth = std::stoi (optarg);
+                break;
+            case 'O':
+                op = optarg;
+                break;
+            case 'F':
+                fmt = optarg;
+                break;
+            case 'V':
+                validate_n = std::stoi (optarg);
+                break;
+            case 'A':
+                anim_path = optarg;
+                break;
+            case 'K':
+                anim_every = std::stoi (optarg);
+                break;
             case '?':
                 break;
         }
     }
 
-    if (size == -1) {
-        std::cerr << argv[0] << ": missing argument `--size' (aka `-S')\n";
+    // `--serve -' speaks the protocol over stdin/stdout
+    if (!serve_path.empty ())
+        return serve (serve_path, workers, log_level);
+
+    // `--rows' and `--cols' override `--size' for rectangular mazes
+    if (rows == -1)
+        rows = size;
+    if (cols == -1)
+        cols = size;
+
+    if (rows == -1 || cols == -1) {
+        std::cerr << argv[0]
+                  << ": missing argument `--size' (aka `-S') or `--rows' and "
+                     "`--cols'\n";
         abort ();
     }
 
+    if (!loadgen_path.empty ())
+        return loadgen (loadgen_path, op, fmt, rows, cols, requests, depth,
+                        log_level);
+
+    // generate `validate_n' mazes with seeds 0, 1, ... and check each one
+    if (validate_n > 0) {
+        int          failed = 0;
+        open_tally_t tally (rows, cols);
+        auto         start = std::chrono::steady_clock::now ();
+        for (int i = 0; i < validate_n; ++i) {
+            cv::Mat maze = generate_rect (rows, cols, 0, i);
+            if (maze.empty ()) {
+                if (log_level > 0) {
+                    std::cerr << "[ \033[31;1mFAILED\033[0m ] seed " << i
+                              << ": cannot generate a " << rows << 'x' << cols
+                              << " maze\n";
+                }
+                return 1;
+            }
+
+            tally.add (maze);
+            maze_report_t rep = validate (maze, workers);
+            if (rep.ok ())
+                continue;
+
+            ++failed;
+            if (log_level > 0) {
+                std::cout << "[ \033[31;1mFAILED\033[0m ] seed " << i
+                          << ": " << rep.cycles << " cycles, "
+                          << rep.isolated << " isolated regions, "
+                          << rep.broken_border << " broken border pixels, "
+                          << rep.closed_cells << " closed cells, entrance "
+                          << (rep.entrance_open ? "open" : "closed")
+                          << ", exit " << (rep.exit_open ? "open" : "closed")
+                          << '\n';
+            }
+        }
+
+        double secs = std::chrono::duration<double> (
+                          std::chrono::steady_clock::now () - start)
+                          .count ();
+        if (log_level > 0) {
+            std::cout << "[  \033[37;1mINFO\033[0m  ] validated "
+                      << validate_n - failed << '/' << validate_n
+                      << " mazes in " << secs << " s" << std::endl;
+        }
+
+        // every maze can be perfect while the generator still favors some
+        // walls, so compare how often each wall and its mirror images open
+        cv::Point a, b;
+        int       skewed = tally.skewed (VL_SKEW_Z, &a, &b);
+        if (skewed > 0 && log_level > 0) {
+            std::cout << "[ \033[31;1mFAILED\033[0m ] " << skewed
+                      << " walls open unlike their mirror image, worst ("
+                      << a.y << ", " << a.x << ") "
+                      << tally.open[(size_t)a.y * cols + a.x] << " vs ("
+                      << b.y << ", " << b.x << ") "
+                      << tally.open[(size_t)b.y * cols + b.x] << " of "
+                      << validate_n << '\n';
+        }
+
+        return failed == 0 && skewed == 0 ? 0 : 1;
+    }
+
     if (log_level > 1) {
         std::cout << "[  \033[37;1mINFO\033[0m  ] set log level to "
                   << log_level << std::endl;
-        if (size > 160) {
+        if ((long long)rows * cols > 160 * 160) {
             std::cout << "\033[33;1mwarning:\033[0m high log levels may cause "
                          "significant I/O pressure and reduce performance. "
                          "continue? [Y/n]"
@@ -73,10 +211,25 @@ main (int argc, char **argv)
         }
     }
 
-    cv::Mat maze = generate (size, log_level);
+    std::random_device rd;
+    cv::Mat            maze;
+    if (anim_path.empty ()) {
+        maze = generate_rect (rows, cols, log_level, rd ());
+    } else {
+        frame_pipeline anim (anim_path, anim_every, 8, log_level);
+        maze = generate_rect (rows, cols, log_level, rd (), &anim);
+    }
+
+    if (maze.empty ())
+        return 1;
+
+    // fit the longer side to 1024 pixels
+    double   fit = 1024.0 / std::max (rows, cols);
+    cv::Size disp (std::max (1, (int)(cols * fit)),
+                   std::max (1, (int)(rows * fit)));
 
     cv::Mat resized;
-    cv::resize (maze, resized, cv::Size (1024, 1024), 0, 0, cv::INTER_NEAREST);
+    cv::resize (maze, resized, disp, 0, 0, cv::INTER_NEAREST);
     cv::imshow ("maze output", resized);
     char key = cv::waitKey (0);
     if (key == 's') {
@@ -86,10 +239,9 @@ main (int argc, char **argv)
                   << std::endl;
     }
 
-    resized = cv_morph_solve (maze);
-    cv::resize (resized, resized, cv::Size (1024, 1024), 0, 0,
-                cv::INTER_NEAREST);
-    cv::imshow ("solved maze (using opencv morphology)", resized);
+    resized = solve (maze);
+    cv::resize (resized, resized, disp, 0, 0, cv::INTER_NEAREST);
+    cv::imshow ("solved maze", resized);
     cv::waitKey (0);
     if (key == 's') {
         cv::imwrite ("assets/solved_maze.jpg", resized);